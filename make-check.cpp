@@ -0,0 +1,274 @@
+/*
+Webmake / https://github.com/jaaskelainen-aj/webmake
+Copyright 2017-2019, Antti Jääskeläinen
+https://antti.jaaskelainen.family
+
+MIT License:
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include <dirent.h>
+#include <string.h>
+#include <strings.h>
+#include <sys/stat.h>
+#include <atomic>
+#include <sstream>
+#include <thread>
+#include "webmake.hpp"
+
+struct BrokenRef {
+    string page;
+    string ref;
+    int line;
+    string chain;
+};
+
+// ----------------------------------------------------------------------
+// Adds all regular files under the output directory to the asset set.
+// Names are stored relative to the output directory.
+static void scan_output(const string &root, const string &rel, unordered_set<string> &assets)
+{
+    DIR *dp = opendir((root+rel).c_str());
+    if(!dp)
+        return;
+    struct dirent *de;
+    struct stat st;
+    while((de = readdir(dp)) != 0) {
+        if(!strcmp(de->d_name, ".") || !strcmp(de->d_name, ".."))
+            continue;
+        string name = rel + de->d_name;
+        if(stat((root+name).c_str(), &st))
+            continue;
+        if(S_ISDIR(st.st_mode))
+            scan_output(root, name+'/', assets);
+        else if(S_ISREG(st.st_mode))
+            assets.insert(name);
+    }
+    closedir(dp);
+}
+// ----------------------------------------------------------------------
+// Returns the output relative file name the reference points to or an empty
+// string if the reference is external, an anchor or otherwise not checkable.
+static string resolve_ref(const string &page, const string &ref)
+{
+    if(ref.empty() || ref[0]=='#')
+        return string();
+    if(ref.compare(0, 2, "//") == 0 || ref.find("{{") != string::npos || ref.find("<%") != string::npos)
+        return string();
+    // Any scheme (http:, mailto:, data:, javascript: ...) is external.
+    size_t colon = ref.find(':');
+    if(colon != string::npos && ref.find_first_of("/?#") > colon)
+        return string();
+
+    string target = ref.substr(0, ref.find_first_of("?#"));
+    if(target.empty())
+        return string();
+    if(target[0] != '/') {
+        size_t slash = page.rfind('/');
+        if(slash != string::npos)
+            target = page.substr(0, slash+1) + target;
+    }
+    if(target[target.size()-1] == '/')
+        target += "index.html";
+
+    return normalize_path(target);
+}
+// ----------------------------------------------------------------------
+// Finds the innermost source of the page that contains the reference text.
+static string find_chain(const vector<string> &chains, const string &ref, unordered_map<string,string> &cache)
+{
+    string outer;
+    for(vector<string>::const_reverse_iterator ci=chains.rbegin(); ci!=chains.rend(); ci++) {
+        size_t sep = ci->rfind(" > ");
+        string src = sep == string::npos ? *ci : ci->substr(sep+3);
+        unordered_map<string,string>::iterator cached = cache.find(src);
+        if(cached == cache.end()) {
+            ifstream inp(src.c_str());
+            ostringstream content;
+            if(inp)
+                content << inp.rdbuf();
+            cached = cache.insert(make_pair(src, content.str())).first;
+        }
+        if(cached->second.find(ref) != string::npos)
+            return *ci;
+        outer = *ci;
+    }
+    return outer;
+}
+// ----------------------------------------------------------------------
+static void check_page(const string &root, const string &page, WebMakeApp *app, const unordered_set<string> &assets,
+                       unordered_map<string,string> &cache, vector<BrokenRef> &broken)
+{
+    ifstream inp((root+page).c_str());
+    if(!inp) {
+        BrokenRef br;
+        br.page = page;
+        br.line = 0;
+        broken.push_back(br);
+        return;
+    }
+    ostringstream content;
+    content << inp.rdbuf();
+    const string html = content.str();
+    const char *data = html.c_str();
+    const size_t len = html.size();
+
+    int line = 1;
+    size_t counted = 0;
+    size_t pos = 0;
+    while(pos<len) {
+        const char *lt = (const char*)memchr(data+pos, '<', len-pos);
+        if(!lt)
+            break;
+        pos = lt-data+1;
+        if(!strncmp(data+pos, "!--", 3)) {
+            const char *end = strstr(data+pos, "-->");
+            if(!end)
+                break;
+            pos = end-data+3;
+            continue;
+        }
+        // Closing tags, doctype and a lone '<' in text have no tag name.
+        size_t name_end = pos;
+        while(name_end<len && isalnum((unsigned char)data[name_end]))
+            name_end++;
+        if(name_end == pos)
+            continue;
+        string tag(data+pos, name_end-pos);
+        pos = name_end;
+
+        // Attributes up to the end of the tag.
+        while(pos<len && data[pos]!='>') {
+            if(isspace((unsigned char)data[pos]) || data[pos]=='/') {
+                pos++;
+                continue;
+            }
+            size_t attr = pos;
+            while(pos<len && !isspace((unsigned char)data[pos]) && !strchr("=>/", data[pos]))
+                pos++;
+            if(pos == attr) {
+                pos++;
+                continue;
+            }
+            size_t attr_len = pos-attr;
+            while(pos<len && isspace((unsigned char)data[pos])) pos++;
+            if(pos>=len || data[pos]!='=')
+                continue;
+            pos++;
+            while(pos<len && isspace((unsigned char)data[pos])) pos++;
+            size_t vp = pos, ve;
+            if(pos<len && (data[pos]=='"' || data[pos]=='\'')) {
+                const char *end = (const char*)memchr(data+pos+1, data[pos], len-pos-1);
+                if(!end)
+                    return;
+                vp = pos+1;
+                ve = end-data;
+                pos = ve+1;
+            } else {
+                while(pos<len && !isspace((unsigned char)data[pos]) && data[pos]!='>')
+                    pos++;
+                ve = pos;
+            }
+            bool link = (attr_len==4 && !strncasecmp(data+attr, "href", 4))
+                || (attr_len==3 && !strncasecmp(data+attr, "src", 3));
+            if(!link || ve == vp)
+                continue;
+
+            string ref(data+vp, ve-vp);
+            string target = resolve_ref(page, ref);
+            if(target.empty())
+                continue;
+            // Build targets left over from earlier builds, e.g. with an old version postfix,
+            // do not count even if they still exist in the output directory.
+            if(target.find('/') != string::npos || !app->isStaleTarget(target)) {
+                if(app->artifacts.count(target) || assets.count(target))
+                    continue;
+            }
+
+            for(; counted<vp; counted++)
+                if(data[counted]=='\n') line++;
+            BrokenRef br;
+            br.page = page;
+            br.ref = ref;
+            br.line = line;
+            unordered_map<string, vector<string> >::const_iterator ps = app->page_sources.find(page);
+            if(ps != app->page_sources.end())
+                br.chain = find_chain(ps->second, ref, cache);
+            broken.push_back(br);
+        }
+
+        // Script and style content is not html.
+        if(!strcasecmp(tag.c_str(), "script") || !strcasecmp(tag.c_str(), "style")) {
+            string close = "</"+tag;
+            while(pos<len) {
+                const char *end = (const char*)memchr(data+pos, '<', len-pos);
+                if(!end) {
+                    pos = len;
+                    break;
+                }
+                pos = end-data;
+                if(!strncasecmp(data+pos, close.c_str(), close.size()))
+                    break;
+                pos++;
+            }
+        }
+    }
+}
+// ----------------------------------------------------------------------
+int CheckLinks(path_list &html_files, WebMakeApp *app)
+{
+    cout<<"Checking HTML references.\n";
+    string root = app->dir.get_dir();
+    if(!root.empty() && root[root.size()-1]!='/')
+        root += '/';
+    unordered_set<string> assets;
+    scan_output(root, string(), assets);
+
+    vector<string> pages;
+    for(path_iterator html=html_files.begin(); html!=html_files.end(); html++)
+        pages.push_back(html->get_base());
+    if(pages.empty())
+        return 0;
+
+    // Pages are handed out to workers one at a time. Each worker collects into its own slot
+    // so that the artifact and asset sets are the only shared state and they are read only here.
+    size_t workers = thread::hardware_concurrency();
+    if(workers == 0)
+        workers = 2;
+    if(workers > pages.size())
+        workers = pages.size();
+    vector< vector<BrokenRef> > results(pages.size());
+    atomic<size_t> next(0);
+    vector<thread> pool;
+    for(size_t wi=0; wi<workers; wi++) {
+        pool.push_back(thread([&]() {
+            unordered_map<string,string> cache;
+            for(size_t ndx=next++; ndx<pages.size(); ndx=next++)
+                check_page(root, pages[ndx], app, assets, cache, results[ndx]);
+        }));
+    }
+    for(vector<thread>::iterator ti=pool.begin(); ti!=pool.end(); ti++)
+        ti->join();
+
+    int count = 0;
+    for(size_t ndx=0; ndx<results.size(); ndx++) {
+        for(vector<BrokenRef>::iterator br=results[ndx].begin(); br!=results[ndx].end(); br++) {
+            count++;
+            if(br->line == 0) {
+                cout<<"  "<<br->page<<": page not found from output directory.\n";
+                continue;
+            }
+            cout<<"  "<<br->page<<':'<<br->line<<": broken reference '"<<br->ref<<"'\n";
+            if(!br->chain.empty())
+                cout<<"    from: "<<br->chain<<'\n';
+        }
+    }
+    if(app->isVerbose() || count)
+        cout<<"Checked "<<pages.size()<<" pages, "<<count<<" broken references.\n";
+    return count;
+}
@@ -30,6 +30,7 @@ void MakeCSS(path_list &files, WebMakeApp *app)
             ofstream css(app->dir.get_path().c_str());
             css << sass_context_get_output_string(ctx);
             css.close();
+            app->addArtifact(app->dir.get_base());
         } else {
             cerr<<sass_context_get_error_message(ctx)<<'\n';
         }
@@ -33,6 +33,8 @@ void MakeHTML(path_list &files, WebMakeApp *app)
             cout<<"MakeHTML - Unable to open output file: "<<app->dir.get_path()<<'\n';
             continue;
         }
+        app->addArtifact(html->get_base());
+        app->beginPage(html->get_base());
         if(!app->isVerbose())
             cout<<"  "<<html->get_base()<<"\n";
         process_file(*html, target, app);
@@ -49,6 +51,7 @@ void process_markdown(const path &inp, ofstream &target, WebMakeApp *app)
         cout<<"MakeHTML - Markdown file "<<inp.get_path()<<" not found.\n";
         return;
     }
+    app->recordSource(inp.get_path());
 
     ex_p.set_ext(".html");
     ifstream md(inp.get_path().c_str());
@@ -97,6 +100,7 @@ void process_file(const path &inp, ofstream &target, WebMakeApp *app)
     }
     if(app->isVerbose())
         cout<<"  processing:"<<inp.get_path()<<"; with filter ("<<app->getHtmlFilter()<<")\n";
+    app->pushSource(inp.get_path());
     dirstack.push(inp);
     while(!input.eof()) {
         input.read(&ch, 1);
@@ -218,5 +222,6 @@ void process_file(const path &inp, ofstream &target, WebMakeApp *app)
         }
         prev_ch = ch;
     }
+    app->popSource();
     dirstack.pop();
 }
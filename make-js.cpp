@@ -45,7 +45,8 @@ void MakeJS(path_list &files, WebMakeApp *app)
             if(java() != 0) {
                 cerr << "MakeJS - Closure failed:\n";
                 cerr << err.str()<<"\n";
-            }
+            } else
+                app->addArtifact(app->dir.get_base());
         }
         catch(process_exception pe) {
             cerr<<"MakeJS - Closure failed: "<<pe.what()<<'\n';
@@ -61,6 +62,7 @@ void MakeJS(path_list &files, WebMakeApp *app)
                     cout<<"  appending:"<<js->get_base()<<'\n';
                 app->dir.cat(*js);
             }
+            app->addArtifact(app->dir.get_base());
         }
         catch(const c4s_exception &ce) {
             cerr<<"Concatenation of js-files failed. Check the file paths from config.\n";
@@ -0,0 +1,1041 @@
+/*
+Webmake / https://github.com/jaaskelainen-aj/webmake
+Copyright 2017-2019, Antti Jääskeläinen
+https://antti.jaaskelainen.family
+
+MIT License:
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <algorithm>
+#include <atomic>
+#include <iomanip>
+#include <sstream>
+#include <thread>
+#include "webmake.hpp"
+
+// Scanned modules are cached here by the hash of their path and content. Entries of changed
+// or removed modules are not pruned; the directory can be deleted at any time.
+const char *MODULE_CACHE = ".webmake";
+// Increase when the format of the scanned module changes.
+const char *MODULE_CACHE_VERSION = "3";
+
+struct JsModule {
+    string id;              // Path relative to current directory.
+    string text;            // Scope wrapped module.
+    vector<string> deps;    // Ids of the imported modules.
+    int mark;               // Topological sort state.
+};
+
+static bool is_ident(char ch)
+{
+    return isalnum((unsigned char)ch) || ch=='_' || ch=='$';
+}
+// Keywords after which a slash starts a regular expression instead of a division.
+static bool is_operator_word(const string &word)
+{
+    return word=="return" || word=="typeof" || word=="case" || word=="void" || word=="in"
+        || word=="of" || word=="delete" || word=="new" || word=="throw" || word=="yield";
+}
+static bool is_file(const string &name)
+{
+    struct stat st;
+    return !stat(name.c_str(), &st) && S_ISREG(st.st_mode);
+}
+// Normalizes a file system path. Unlike normalize_path(), which is meant for urls, leading
+// '..' segments are kept and absolute paths stay absolute.
+static string module_path(const string &file)
+{
+    bool absolute = !file.empty() && file[0]=='/';
+    vector<string> parts;
+    size_t start = 0;
+    while(start <= file.size()) {
+        size_t end = file.find('/', start);
+        if(end == string::npos)
+            end = file.size();
+        string seg = file.substr(start, end-start);
+        if(seg == "..") {
+            if(!parts.empty() && parts.back() != "..")
+                parts.pop_back();
+            else if(!absolute)
+                parts.push_back(seg);
+        }
+        else if(!seg.empty() && seg != ".")
+            parts.push_back(seg);
+        start = end+1;
+    }
+    string result = absolute ? "/" : "";
+    for(vector<string>::iterator pi=parts.begin(); pi!=parts.end(); pi++) {
+        if(pi!=parts.begin())
+            result += '/';
+        result += *pi;
+    }
+    return result;
+}
+
+// ----------------------------------------------------------------------
+// Rewrites the import and export statements of a single ES module so that it can be
+// executed inside a function scope. Imported modules are looked up from the '__wm_m'
+// registry and exports are published as getters on '__wm_exports'. References to imported
+// bindings read through the module object so that the bindings stay live.
+class ModuleParser {
+public:
+    ModuleParser(const string &_id, const string &_src) : id(_id), src(_src), imports(0) {}
+    void parse(JsModule &mod);
+
+private:
+    size_t skip_ws(size_t pos);
+    size_t skip_string(size_t pos);
+    size_t skip_template(size_t pos);
+    size_t skip_regex(size_t pos);
+    size_t skip_code(size_t pos, char closing);
+    size_t skip_comment(size_t pos);
+    size_t skip_expression(size_t pos);
+    size_t skip_template_chunk(size_t pos, vector<char> &scope, char &last);
+    bool ends_statement(size_t pos, char last);
+    size_t read_word(size_t pos, string &word);
+    size_t read_spec(size_t pos, string &spec);
+    size_t parse_import(size_t pos, string &out);
+    size_t parse_export(size_t pos, string &out);
+    size_t parse_names(size_t pos, vector<pair<string,string> > &names);
+    size_t parse_declarators(size_t pos, vector<string> &names);
+    void collect_bindings(size_t pos, size_t end, vector<string> &names);
+    void check_shadowing(const vector<string> &names, size_t pos);
+    string rewrite_imports();
+    string resolve(const string &spec);
+    string registry(const string &spec);
+    void error(const string &msg, size_t pos);
+
+    string id;
+    string src;
+    int imports;
+    string header;
+    string stars;                                   // 'export *' calls, after own exports.
+    vector<string> deps;
+    unordered_map<string,string> imported;          // Local name -> module object property.
+    vector<pair<string,string> > exports;           // Exported name -> local expression.
+};
+
+// ----------------------------------------------------------------------
+void ModuleParser::error(const string &msg, size_t pos)
+{
+    int line = 1;
+    for(size_t ndx=0; ndx<pos && ndx<src.size(); ndx++)
+        if(src[ndx]=='\n') line++;
+    ostringstream err;
+    err<<"MakeJS - "<<id<<':'<<line<<": "<<msg;
+    throw runtime_error(err.str());
+}
+// ----------------------------------------------------------------------
+// Returns the position after the comment or 'pos' if there is no comment at 'pos'.
+size_t ModuleParser::skip_comment(size_t pos)
+{
+    if(src[pos]!='/' || pos+1>=src.size())
+        return pos;
+    if(src[pos+1]=='/') {
+        size_t end = src.find('\n', pos);
+        return end == string::npos ? src.size() : end;
+    }
+    if(src[pos+1]=='*') {
+        size_t end = src.find("*/", pos+2);
+        return end == string::npos ? src.size() : end+2;
+    }
+    return pos;
+}
+// ----------------------------------------------------------------------
+size_t ModuleParser::skip_ws(size_t pos)
+{
+    while(pos<src.size()) {
+        if(isspace((unsigned char)src[pos])) {
+            pos++;
+            continue;
+        }
+        size_t end = skip_comment(pos);
+        if(end == pos)
+            break;
+        pos = end;
+    }
+    return pos;
+}
+// ----------------------------------------------------------------------
+size_t ModuleParser::skip_string(size_t pos)
+{
+    char quote = src[pos++];
+    while(pos<src.size() && src[pos]!=quote) {
+        if(src[pos]=='\\')
+            pos++;
+        pos++;
+    }
+    return pos+1;
+}
+// ----------------------------------------------------------------------
+size_t ModuleParser::skip_template(size_t pos)
+{
+    pos++;
+    while(pos<src.size() && src[pos]!='`') {
+        if(src[pos]=='\\')
+            pos += 2;
+        else if(src[pos]=='$' && pos+1<src.size() && src[pos+1]=='{')
+            pos = skip_code(pos+2, '}');
+        else
+            pos++;
+    }
+    return pos+1;
+}
+// ----------------------------------------------------------------------
+size_t ModuleParser::skip_regex(size_t pos)
+{
+    bool in_class = false;
+    pos++;
+    while(pos<src.size() && src[pos]!='\n') {
+        if(src[pos]=='\\')
+            pos++;
+        else if(src[pos]=='[')
+            in_class = true;
+        else if(src[pos]==']')
+            in_class = false;
+        else if(src[pos]=='/' && !in_class)
+            break;
+        pos++;
+    }
+    pos++;
+    while(pos<src.size() && is_ident(src[pos]))
+        pos++;
+    return pos;
+}
+// ----------------------------------------------------------------------
+// Skips code until the 'closing' character on the same nesting level. Returns the
+// position after it. Use closing=0 to stop at the end of the source.
+size_t ModuleParser::skip_code(size_t pos, char closing)
+{
+    int depth = 0;
+    char last = '(';
+    while(pos<src.size()) {
+        char ch = src[pos];
+        if(isspace((unsigned char)ch)) {
+            pos++;
+            continue;
+        }
+        size_t end = skip_comment(pos);
+        if(end != pos) {
+            pos = end;
+            continue;
+        }
+        if(ch=='"' || ch=='\'')
+            pos = skip_string(pos);
+        else if(ch=='`')
+            pos = skip_template(pos);
+        else if(ch=='/' && !is_ident(last) && !strchr(")]}", last))
+            pos = skip_regex(pos);
+        else if(is_ident(ch)) {
+            string word;
+            pos = read_word(pos, word);
+            ch = is_operator_word(word) ? '(' : 'a';
+        }
+        else {
+            if(ch=='(' || ch=='[' || ch=='{')
+                depth++;
+            else if(ch==')' || ch==']' || ch=='}') {
+                if(depth==0 && ch==closing)
+                    return pos+1;
+                depth--;
+            }
+            pos++;
+        }
+        last = ch;
+    }
+    return pos;
+}
+// ----------------------------------------------------------------------
+// A line break ends the statement if the previous token can end an expression and the
+// next token can not continue it.
+bool ModuleParser::ends_statement(size_t pos, char last)
+{
+    if(!is_ident(last) && !strchr(")]}\"", last))
+        return false;
+    size_t next = skip_ws(pos);
+    if(next>=src.size())
+        return true;
+    char ch = src[next];
+    if(is_ident(ch)) {
+        string word;
+        read_word(next, word);
+        return word!="in" && word!="instanceof" && word!="of";
+    }
+    return ch=='"' || ch=='\'' || ch=='{';
+}
+// ----------------------------------------------------------------------
+// Skips an assignment expression. Returns the position of the ',', ';' or closing bracket
+// that ends it, or of the line break that ends the statement.
+size_t ModuleParser::skip_expression(size_t pos)
+{
+    char last = '=';
+    while(pos<src.size()) {
+        char ch = src[pos];
+        if(ch=='\n' && ends_statement(pos, last))
+            return pos;
+        if(isspace((unsigned char)ch)) {
+            pos++;
+            continue;
+        }
+        size_t end = skip_comment(pos);
+        if(end != pos) {
+            pos = end;
+            continue;
+        }
+        if(ch==',' || ch==';' || ch==')' || ch==']' || ch=='}')
+            return pos;
+        if(ch=='"' || ch=='\'') {
+            pos = skip_string(pos);
+            ch = '"';
+        }
+        else if(ch=='`') {
+            pos = skip_template(pos);
+            ch = '"';
+        }
+        else if(ch=='/' && !is_ident(last) && !strchr(")]}\"", last)) {
+            pos = skip_regex(pos);
+            ch = 'a';
+        }
+        else if(is_ident(ch)) {
+            string word;
+            pos = read_word(pos, word);
+            ch = is_operator_word(word) ? '(' : 'a';
+        }
+        else if(ch=='(' || ch=='[' || ch=='{') {
+            pos = skip_code(pos+1, ch=='(' ? ')' : (ch=='[' ? ']' : '}'));
+            ch = ')';
+        }
+        else
+            pos++;
+        last = ch;
+    }
+    return pos;
+}
+// ----------------------------------------------------------------------
+// Collects the names declared by 'var', 'let' or 'const' starting after the keyword.
+// Returns the position after the last declarator.
+size_t ModuleParser::parse_declarators(size_t pos, vector<string> &names)
+{
+    for(;;) {
+        pos = skip_ws(pos);
+        if(pos<src.size() && (src[pos]=='{' || src[pos]=='[')) {
+            size_t end = skip_code(pos+1, src[pos]=='{' ? '}' : ']');
+            collect_bindings(pos+1, end-1, names);
+            pos = end;
+        } else {
+            string name;
+            pos = read_word(pos, name);
+            if(name.empty() || isdigit((unsigned char)name[0]))
+                error("unable to parse declaration", pos);
+            names.push_back(name);
+        }
+        size_t next = skip_ws(pos);
+        if(next+1<src.size() && src[next]=='=' && src[next+1]!='=')
+            pos = skip_expression(next+1);
+        next = skip_ws(pos);
+        if(next>=src.size() || src[next]!=',')
+            return pos;
+        pos = next+1;
+    }
+}
+// ----------------------------------------------------------------------
+// Collects the names bound by a parameter list or a destructuring pattern between 'pos'
+// and 'end'. Default values and property keys are skipped.
+void ModuleParser::collect_bindings(size_t pos, size_t end, vector<string> &names)
+{
+    string word;
+    while(pos<end) {
+        char ch = src[pos];
+        size_t next = skip_comment(pos);
+        if(next != pos) {
+            pos = next;
+            continue;
+        }
+        if(ch=='=' && src[pos+1]!='>')
+            pos = skip_expression(pos+1);
+        else if(ch=='"' || ch=='\'')
+            pos = skip_string(pos);
+        else if(is_ident(ch)) {
+            pos = read_word(pos, word);
+            next = skip_ws(pos);
+            if((next>=end || src[next]!=':') && !isdigit((unsigned char)word[0]))
+                names.push_back(word);
+        }
+        else
+            pos++;
+    }
+}
+// ----------------------------------------------------------------------
+void ModuleParser::check_shadowing(const vector<string> &names, size_t pos)
+{
+    for(vector<string>::const_iterator ni=names.begin(); ni!=names.end(); ni++) {
+        if(imported.count(*ni))
+            error("local declaration of imported name '"+*ni+"' is not supported, rename it", pos);
+    }
+}
+// ----------------------------------------------------------------------
+// Scans template literal text up to the closing backtick or to the next '${'.
+size_t ModuleParser::skip_template_chunk(size_t pos, vector<char> &scope, char &last)
+{
+    while(pos<src.size()) {
+        if(src[pos]=='\\')
+            pos += 2;
+        else if(src[pos]=='`') {
+            last = '"';
+            return pos+1;
+        }
+        else if(src[pos]=='$' && pos+1<src.size() && src[pos+1]=='{') {
+            scope.push_back('t');
+            last = '(';
+            return pos+2;
+        }
+        else
+            pos++;
+    }
+    return pos;
+}
+// ----------------------------------------------------------------------
+// Replaces references to imported names with reads of the module object property. Braces
+// are tracked as blocks (b), object literals (o), class bodies (c) and template
+// expressions (t) to tell property keys and member names apart from references. Open
+// ternaries are counted per nesting level so that the colon of 'case', 'default' and labels
+// can be told apart from the ternary colon. Local declarations that shadow an imported
+// name are rejected.
+string ModuleParser::rewrite_imports()
+{
+    string out, word, last_word;
+    vector<char> scope;
+    vector<int> ternary(1, 0);      // Open '?' on each nesting level.
+    size_t pos = 0, emitted = 0;
+    size_t class_depth = string::npos;
+    char last = ';';
+
+    if(imported.empty())
+        return src;
+    while(pos<src.size()) {
+        char ch = src[pos];
+        if(isspace((unsigned char)ch)) {
+            pos++;
+            continue;
+        }
+        size_t end = skip_comment(pos);
+        if(end != pos) {
+            pos = end;
+            continue;
+        }
+        char top = scope.empty() ? 'b' : scope.back();
+        if(ch=='"' || ch=='\'') {
+            pos = skip_string(pos);
+            last = '"';
+        }
+        else if(ch=='`') {
+            pos = skip_template_chunk(pos+1, scope, last);
+            ternary.resize(scope.size()+1, 0);
+        }
+        else if(ch=='/' && !is_ident(last) && !strchr(")]}\"", last)) {
+            pos = skip_regex(pos);
+            last = 'a';
+        }
+        else if(is_ident(ch)) {
+            size_t start = pos;
+            pos = read_word(pos, word);
+            size_t next = skip_ws(pos);
+            char follow = next<src.size() ? src[next] : 0;
+            // Keywords used as property names are not declarations.
+            bool keyword = last!='.' && follow!=':';
+            if(keyword && (word=="var" || word=="let" || word=="const")) {
+                vector<string> names;
+                parse_declarators(pos, names);
+                check_shadowing(names, start);
+            }
+            else if(keyword && (word=="function" || (word=="class" && follow!='('))) {
+                string name;
+                read_word(follow=='*' ? next+1 : next, name);
+                check_shadowing(vector<string>(1, name), start);
+                if(word=="class")
+                    class_depth = scope.size();
+            }
+            else if(imported.count(word) && last!='.' && !isdigit((unsigned char)ch)) {
+                bool member = false, shorthand = false;
+                if(follow=='=' && next+1<src.size() && src[next+1]=='>')
+                    check_shadowing(vector<string>(1, word), start);
+                if(top=='o' && (last=='{' || last==',')) {
+                    member = follow==':' || follow=='(';
+                    shorthand = follow==',' || follow=='}';
+                }
+                else if(top=='o' && follow=='(' && (last_word=="get" || last_word=="set" || last_word=="async"))
+                    member = true;
+                else if(top=='c' && (last=='{' || last=='}' || last==';' || last=='*' || last_word=="static"
+                                     || last_word=="get" || last_word=="set" || last_word=="async"))
+                    member = true;
+                if(!member) {
+                    out.append(src, emitted, start-emitted);
+                    if(shorthand)
+                        out += word+": ";
+                    out += imported[word];
+                    emitted = pos;
+                }
+            }
+            last = is_operator_word(word) ? '(' : 'a';
+            last_word = word;
+            continue;
+        }
+        else if(ch=='=' && pos+1<src.size() && src[pos+1]=='>') {
+            pos += 2;
+            last = 'A';
+        }
+        else if(ch=='?') {
+            if(pos+1<src.size() && src[pos+1]=='?') {
+                pos += 2;
+                last = '?';
+            }
+            else if(pos+2<src.size() && src[pos+1]=='.' && !isdigit((unsigned char)src[pos+2])) {
+                pos += 2;
+                last = '.';
+            }
+            else {
+                ternary.back()++;
+                pos++;
+                last = '?';
+            }
+        }
+        else if(ch==':') {
+            // Property values and ternaries continue an expression. Otherwise the colon ends
+            // a 'case', 'default' or label and a statement follows.
+            if(top=='o')
+                last = ':';
+            else if(ternary.back() > 0) {
+                ternary.back()--;
+                last = ':';
+            }
+            else
+                last = ';';
+            pos++;
+        }
+        else if(ch=='.') {
+            bool spread = !src.compare(pos, 3, "...");
+            pos += spread ? 3 : 1;
+            last = spread ? ',' : '.';
+        }
+        else if(ch=='(') {
+            // Parameter lists of functions, methods, arrows and catch clauses.
+            size_t close = skip_code(pos+1, ')');
+            size_t next = skip_ws(close);
+            bool params = next+1<src.size() && src[next]=='=' && src[next+1]=='>';
+            if(!params && next<src.size() && src[next]=='{' && last=='a')
+                params = last_word!="if" && last_word!="while" && last_word!="for"
+                    && last_word!="switch" && last_word!="with";
+            if(params) {
+                vector<string> names;
+                collect_bindings(pos+1, close-1, names);
+                check_shadowing(names, pos);
+            }
+            scope.push_back('p');
+            ternary.push_back(0);
+            pos++;
+            last = ch;
+        }
+        else if(ch=='[') {
+            scope.push_back('p');
+            ternary.push_back(0);
+            pos++;
+            last = ch;
+        }
+        else if(ch=='{') {
+            char kind = 'b';
+            if(class_depth == scope.size()) {
+                kind = 'c';
+                class_depth = string::npos;
+            }
+            else if(last!='A' && strchr("(,=:[!&|?+-*%<>~^", last))
+                kind = 'o';
+            scope.push_back(kind);
+            ternary.push_back(0);
+            pos++;
+            last = ch;
+        }
+        else if(ch==')' || ch==']' || ch=='}') {
+            if(!scope.empty()) {
+                scope.pop_back();
+                ternary.pop_back();
+            }
+            if(ch=='}' && top=='t') {
+                pos = skip_template_chunk(pos+1, scope, last);
+                ternary.resize(scope.size()+1, 0);
+            }
+            else {
+                pos++;
+                last = ch;
+            }
+        }
+        else {
+            pos++;
+            last = ch;
+        }
+        last_word.clear();
+    }
+    out.append(src, emitted, string::npos);
+    return out;
+}
+// ----------------------------------------------------------------------
+size_t ModuleParser::read_word(size_t pos, string &word)
+{
+    pos = skip_ws(pos);
+    size_t start = pos;
+    while(pos<src.size() && is_ident(src[pos]))
+        pos++;
+    word = src.substr(start, pos-start);
+    return pos;
+}
+// ----------------------------------------------------------------------
+size_t ModuleParser::read_spec(size_t pos, string &spec)
+{
+    pos = skip_ws(pos);
+    if(pos>=src.size() || (src[pos]!='"' && src[pos]!='\''))
+        error("module specifier expected", pos);
+    size_t end = skip_string(pos);
+    spec = src.substr(pos+1, end-pos-2);
+    end = skip_ws(end);
+    if(end<src.size() && src[end]==';')
+        end++;
+    return end;
+}
+// ----------------------------------------------------------------------
+// Parses '{ a, b as c }'. Pairs are stored as (name, alias).
+size_t ModuleParser::parse_names(size_t pos, vector<pair<string,string> > &names)
+{
+    string name, alias;
+    pos = skip_ws(pos)+1;
+    for(;;) {
+        pos = skip_ws(pos);
+        if(pos>=src.size())
+            error("unterminated name list", pos);
+        if(src[pos]=='}')
+            return pos+1;
+        if(src[pos]==',') {
+            pos++;
+            continue;
+        }
+        pos = read_word(pos, name);
+        if(name.empty())
+            error("unsupported name in import/export list", pos);
+        size_t next = read_word(pos, alias);
+        if(alias == "as")
+            pos = read_word(next, alias);
+        else
+            alias = name;
+        names.push_back(make_pair(name, alias));
+    }
+}
+// ----------------------------------------------------------------------
+string ModuleParser::resolve(const string &spec)
+{
+    if(spec.compare(0, 2, "./") && spec.compare(0, 3, "../") && spec[0]!='/')
+        throw runtime_error("MakeJS - "+id+": unable to resolve bare module '"+spec+"'.");
+    string base;
+    size_t slash = id.rfind('/');
+    if(spec[0]!='/' && slash != string::npos)
+        base = id.substr(0, slash+1);
+    string file = module_path(base+spec);
+    if(is_file(file))
+        return file;
+    if(is_file(file+".js"))
+        return file+".js";
+    if(is_file(file+"/index.js"))
+        return file+"/index.js";
+    throw runtime_error("MakeJS - "+id+": module '"+spec+"' not found.");
+}
+// ----------------------------------------------------------------------
+string ModuleParser::registry(const string &spec)
+{
+    string dep = resolve(spec);
+    if(find(deps.begin(), deps.end(), dep) == deps.end())
+        deps.push_back(dep);
+    return "__wm_m[\""+dep+"\"]";
+}
+// ----------------------------------------------------------------------
+// The module objects of imports are hoisted into the module header. Imported names are
+// replaced with module object properties by rewrite_imports().
+size_t ModuleParser::parse_import(size_t pos, string &out)
+{
+    string word, spec, ns, def;
+    vector<pair<string,string> > names;
+
+    pos = skip_ws(pos);
+    if(src[pos]=='"' || src[pos]=='\'') {
+        pos = read_spec(pos, spec);
+        registry(spec);
+        return pos;
+    }
+    if(is_ident(src[pos])) {
+        pos = read_word(pos, def);
+        pos = skip_ws(pos);
+        if(src[pos]==',')
+            pos = skip_ws(pos+1);
+    }
+    if(src[pos]=='*') {
+        pos = read_word(pos+1, word);
+        if(word != "as")
+            error("'as' expected after 'import *'", pos);
+        pos = read_word(pos, ns);
+    }
+    else if(src[pos]=='{')
+        pos = parse_names(pos, names);
+    pos = read_word(pos, word);
+    if(word != "from")
+        error("'from' expected in import", pos);
+    pos = read_spec(pos, spec);
+
+    ostringstream var;
+    var << "__wm_i" << imports++;
+    header += "var "+var.str()+" = "+registry(spec)+";\n";
+    if(!def.empty())
+        imported[def] = var.str()+"[\"default\"]";
+    if(!ns.empty())
+        header += "var "+ns+" = "+var.str()+";\n";
+    for(vector<pair<string,string> >::iterator ni=names.begin(); ni!=names.end(); ni++)
+        imported[ni->second] = var.str()+"[\""+ni->first+"\"]";
+    out.clear();
+    return pos;
+}
+// ----------------------------------------------------------------------
+// Declarations keep their place in the module and only the 'export' keyword is removed.
+size_t ModuleParser::parse_export(size_t pos, string &out)
+{
+    string word, name, spec;
+    vector<pair<string,string> > names;
+
+    out.clear();
+    pos = skip_ws(pos);
+    if(src[pos]=='*') {
+        size_t next = read_word(pos+1, word);
+        if(word == "as") {
+            next = read_word(next, name);
+            next = read_word(next, word);
+        }
+        if(word != "from")
+            error("'from' expected in export", next);
+        next = read_spec(next, spec);
+        if(name.empty())
+            stars += "__wm_star(__wm_exports, "+registry(spec)+");\n";
+        else
+            exports.push_back(make_pair(name, registry(spec)));
+        return next;
+    }
+    if(src[pos]=='{') {
+        pos = parse_names(pos, names);
+        size_t next = read_word(pos, word);
+        string from;
+        if(word == "from") {
+            pos = read_spec(next, spec);
+            from = registry(spec);
+        }
+        else {
+            next = skip_ws(pos);
+            if(next<src.size() && src[next]==';')
+                pos = next+1;
+        }
+        for(vector<pair<string,string> >::iterator ni=names.begin(); ni!=names.end(); ni++)
+            exports.push_back(make_pair(ni->second, from.empty() ? ni->first : from+"[\""+ni->first+"\"]"));
+        return pos;
+    }
+    size_t start = skip_ws(pos);
+    pos = read_word(pos, word);
+    if(word == "default") {
+        start = skip_ws(pos);
+        size_t next = read_word(pos, word);
+        if(word == "async")
+            next = read_word(next, word);
+        if(word == "function" || word == "class") {
+            next = skip_ws(next);
+            if(next<src.size() && src[next]=='*')
+                next++;
+            read_word(next, name);
+        }
+        if(name.empty()) {
+            out = "var __wm_default = ";
+            exports.push_back(make_pair("default", "__wm_default"));
+        } else
+            exports.push_back(make_pair("default", name));
+        return start;
+    }
+    if(word == "async")
+        pos = read_word(pos, word);
+    if(word == "function" || word == "class") {
+        pos = skip_ws(pos);
+        if(pos<src.size() && src[pos]=='*')
+            pos++;
+        read_word(pos, name);
+        if(name.empty())
+            error("exported "+word+" needs a name", pos);
+        exports.push_back(make_pair(name, name));
+        return start;
+    }
+    if(word == "var" || word == "let" || word == "const") {
+        vector<string> declared;
+        parse_declarators(pos, declared);
+        for(vector<string>::iterator di=declared.begin(); di!=declared.end(); di++)
+            exports.push_back(make_pair(*di, *di));
+        return start;
+    }
+    error("unsupported export '"+word+"'", pos);
+    return pos;
+}
+// ----------------------------------------------------------------------
+void ModuleParser::parse(JsModule &mod)
+{
+    string body, stmt, word;
+    size_t pos = 0, emitted = 0;
+    int depth = 0;
+    char last = ';';
+
+    while(pos<src.size()) {
+        char ch = src[pos];
+        if(isspace((unsigned char)ch)) {
+            pos++;
+            continue;
+        }
+        size_t end = skip_comment(pos);
+        if(end != pos) {
+            pos = end;
+            continue;
+        }
+        if(ch=='"' || ch=='\'')
+            pos = skip_string(pos);
+        else if(ch=='`')
+            pos = skip_template(pos);
+        else if(ch=='/' && !is_ident(last) && !strchr(")]}", last))
+            pos = skip_regex(pos);
+        else if(is_ident(ch)) {
+            size_t start = pos;
+            pos = read_word(pos, word);
+            if(depth==0 && last!='.' && (word=="import" || word=="export")) {
+                size_t next = skip_ws(pos);
+                if(word=="import" && next<src.size() && (src[next]=='(' || src[next]=='.')) {
+                    last = 't';
+                    continue;
+                }
+                body.append(src, emitted, start-emitted);
+                emitted = word=="import" ? parse_import(pos, stmt) : parse_export(pos, stmt);
+                body += stmt;
+                // Keep the line numbers of the source.
+                body.append(count(src.begin()+start, src.begin()+emitted, '\n'), '\n');
+                pos = emitted;
+                last = ';';
+                continue;
+            }
+            ch = is_operator_word(word) ? '(' : 'a';
+        }
+        else {
+            if(ch=='(' || ch=='[' || ch=='{')
+                depth++;
+            else if(ch==')' || ch==']' || ch=='}')
+                depth--;
+            pos++;
+        }
+        last = ch;
+    }
+    body.append(src, emitted, string::npos);
+
+    src = body;
+    body = rewrite_imports();
+    for(vector<pair<string,string> >::iterator ei=exports.begin(); ei!=exports.end(); ei++) {
+        unordered_map<string,string>::iterator imp = imported.find(ei->second);
+        header += "Object.defineProperty(__wm_exports, \""+ei->first+"\", {enumerable: true, get: function() { return "
+            +(imp == imported.end() ? ei->second : imp->second)+"; }});\n";
+    }
+    // Local exports take precedence over 'export *' and __wm_star skips names already defined.
+    header += stars;
+
+    mod.deps = deps;
+    mod.text = "// "+id+"\n(function(__wm_exports) {\n\"use strict\";\n"+header+body
+        +"\n})(__wm_m[\""+id+"\"]);\n";
+}
+
+// ----------------------------------------------------------------------
+static string hash_key(const string &id, const string &content)
+{
+    uint64_t hash = 14695981039346656037ULL;
+    for(const char *vp=MODULE_CACHE_VERSION; *vp; vp++)
+        hash = (hash ^ (unsigned char)*vp) * 1099511628211ULL;
+    for(string::const_iterator ci=id.begin(); ci!=id.end(); ci++)
+        hash = (hash ^ (unsigned char)*ci) * 1099511628211ULL;
+    hash = (hash ^ 0) * 1099511628211ULL;
+    for(string::const_iterator ci=content.begin(); ci!=content.end(); ci++)
+        hash = (hash ^ (unsigned char)*ci) * 1099511628211ULL;
+    ostringstream key;
+    key << hex << setw(16) << setfill('0') << hash;
+    return key.str();
+}
+// ----------------------------------------------------------------------
+// Cache files are written into a temporary file first and renamed into place so that an
+// interrupted or concurrent build never leaves a partial entry behind.
+static bool write_cache(const string &name, const string &content)
+{
+    ostringstream tmp;
+    tmp << name << '.' << getpid() << '.' << this_thread::get_id();
+    ofstream out(tmp.str().c_str(), ofstream::trunc);
+    out << content;
+    out.close();
+    if(!out || rename(tmp.str().c_str(), name.c_str())) {
+        remove(tmp.str().c_str());
+        return false;
+    }
+    return true;
+}
+// ----------------------------------------------------------------------
+// Reads the module and either loads the scan results from cache or parses it.
+static void load_module(const string &id, JsModule &mod, bool verbose)
+{
+    ifstream inp(id.c_str());
+    if(!inp)
+        throw runtime_error("MakeJS - Unable to read module "+id);
+    ostringstream content;
+    content << inp.rdbuf();
+    inp.close();
+
+    mod.id = id;
+    mod.mark = 0;
+    string cache = string(MODULE_CACHE)+'/'+hash_key(id, content.str());
+    ifstream cached_js((cache+".js").c_str());
+    ifstream cached_dep((cache+".dep").c_str());
+    if(cached_js && cached_dep) {
+        ostringstream text;
+        text << cached_js.rdbuf();
+        mod.text = text.str();
+        string dep;
+        while(getline(cached_dep, dep))
+            if(!dep.empty()) mod.deps.push_back(dep);
+        return;
+    }
+    if(verbose)
+        cout<<"  scanning:"<<id<<'\n';
+    ModuleParser parser(id, content.str());
+    parser.parse(mod);
+
+    ostringstream deps;
+    for(vector<string>::iterator di=mod.deps.begin(); di!=mod.deps.end(); di++)
+        deps << *di << '\n';
+    // The .dep file marks the entry complete so it is written last.
+    if(!write_cache(cache+".js", mod.text) || !write_cache(cache+".dep", deps.str()))
+        cout<<"  Warning: unable to write module cache for "<<id<<'\n';
+}
+// ----------------------------------------------------------------------
+static void sort_modules(const string &id, unordered_map<string, JsModule> &modules, vector<JsModule*> &order)
+{
+    JsModule &mod = modules[id];
+    if(mod.mark == 2)
+        return;
+    if(mod.mark == 1)
+        return;
+    mod.mark = 1;
+    for(vector<string>::iterator di=mod.deps.begin(); di!=mod.deps.end(); di++)
+        sort_modules(*di, modules, order);
+    mod.mark = 2;
+    order.push_back(&mod);
+}
+// ----------------------------------------------------------------------
+void MakeModules(path_list &entries, WebMakeApp *app)
+{
+    unordered_map<string, JsModule> modules;
+    vector<string> roots, level;
+
+    mkdir(MODULE_CACHE, 0755);
+    for(path_iterator js=entries.begin(); js!=entries.end(); js++) {
+        string id = module_path(js->get_path());
+        roots.push_back(id);
+        if(find(level.begin(), level.end(), id) == level.end())
+            level.push_back(id);
+    }
+
+    // The graph is scanned breadth first. Modules of one level are independent of each
+    // other and are loaded in parallel.
+    while(!level.empty()) {
+        vector<JsModule> loaded(level.size());
+        vector<string> errors(level.size());
+        size_t workers = thread::hardware_concurrency();
+        if(workers == 0)
+            workers = 2;
+        if(workers > level.size())
+            workers = level.size();
+        atomic<size_t> next(0);
+        vector<thread> pool;
+        for(size_t wi=0; wi<workers; wi++) {
+            pool.push_back(thread([&]() {
+                for(size_t ndx=next++; ndx<level.size(); ndx=next++) {
+                    try {
+                        load_module(level[ndx], loaded[ndx], app->isVerbose());
+                    }
+                    catch(const runtime_error &re) {
+                        errors[ndx] = re.what();
+                    }
+                }
+            }));
+        }
+        for(vector<thread>::iterator ti=pool.begin(); ti!=pool.end(); ti++)
+            ti->join();
+        for(vector<string>::iterator ei=errors.begin(); ei!=errors.end(); ei++)
+            if(!ei->empty())
+                throw runtime_error(*ei);
+
+        vector<string> next_level;
+        for(vector<JsModule>::iterator mi=loaded.begin(); mi!=loaded.end(); mi++)
+            modules[mi->id] = *mi;
+        for(vector<JsModule>::iterator mi=loaded.begin(); mi!=loaded.end(); mi++) {
+            for(vector<string>::iterator di=mi->deps.begin(); di!=mi->deps.end(); di++) {
+                if(!modules.count(*di) && find(next_level.begin(), next_level.end(), *di) == next_level.end())
+                    next_level.push_back(*di);
+            }
+        }
+        level.swap(next_level);
+    }
+
+    vector<JsModule*> order;
+    for(vector<string>::iterator ri=roots.begin(); ri!=roots.end(); ri++)
+        sort_modules(*ri, modules, order);
+
+    // Closure Compiler is given the bundle from the cache directory. Otherwise the
+    // bundle is written directly to target.
+    path bundle(app->dir);
+    if(app->isChromeCC())
+        bundle = path(string(MODULE_CACHE)+'/'+app->dir.get_base());
+    else
+        cout<<"Building JS - "<<app->dir.get_base()<<"\n";
+    ofstream out(bundle.get_path().c_str(), ofstream::trunc);
+    if(!out)
+        throw runtime_error("MakeJS - Unable to open output file: "+bundle.get_path());
+    // Module objects are created up front so that circular imports can refer to them
+    // before the module has been evaluated.
+    out << "(function() {\nvar __wm_m = {};\n";
+    for(vector<JsModule*>::iterator mi=order.begin(); mi!=order.end(); mi++)
+        out << "__wm_m[\""<<(*mi)->id<<"\"] = {};\n";
+    out << "function __wm_star(t, s) { Object.keys(s).forEach(function(k) {\n"
+        << "    if(k !== \"default\" && !Object.prototype.hasOwnProperty.call(t, k))\n"
+        << "        Object.defineProperty(t, k, {enumerable: true, get: function() { return s[k]; }});\n"
+        << "}); }\n";
+    for(vector<JsModule*>::iterator mi=order.begin(); mi!=order.end(); mi++) {
+        if(app->isVerbose())
+            cout<<"  bundling:"<<(*mi)->id<<'\n';
+        out << (*mi)->text;
+    }
+    out << "})();\n";
+    out.close();
+
+    if(app->isChromeCC()) {
+        path_list files;
+        files.add(bundle);
+        MakeJS(files, app);
+    } else
+        app->addArtifact(app->dir.get_base());
+}
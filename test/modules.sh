@@ -0,0 +1,44 @@
+#!/bin/bash
+# ES module bundle tests. Each directory under test/modules is built with 'webmake -js cat'
+# and the bundle is run with node. The output must match expected.txt. Cases with an
+# expected-error.txt must fail to build with a message containing its first line.
+# Usage: test/modules.sh [webmake binary]
+WEBMAKE=${1:-webmake}
+if [[ "$WEBMAKE" == */* ]]; then
+    WEBMAKE="$(cd "$(dirname "$WEBMAKE")" && pwd)/$(basename "$WEBMAKE")"
+fi
+cd "$(dirname "$0")/modules" || exit 1
+
+failed=0
+for dir in */; do
+    name=${dir%/}
+    rm -rf "$name/build" "$name/.webmake"
+    mkdir "$name/build"
+    log=$(cd "$name" && "$WEBMAKE" -js cat 2>&1)
+    status=$?
+    if [ -f "$name/expected-error.txt" ]; then
+        if [ $status == 0 ] || [[ "$log" != *"$(head -1 "$name/expected-error.txt")"* ]]; then
+            echo "FAIL $name: expected build error"
+            echo "$log"
+            failed=1
+            continue
+        fi
+    else
+        if [ $status != 0 ]; then
+            echo "FAIL $name: build failed"
+            echo "$log"
+            failed=1
+            continue
+        fi
+        output=$(node "$name/build/app.js" 2>&1)
+        if [ "$output" != "$(cat "$name/expected.txt")" ]; then
+            echo "FAIL $name:"
+            diff <(echo "$output") "$name/expected.txt"
+            failed=1
+            continue
+        fi
+    fi
+    echo "ok   $name"
+    rm -rf "$name/build" "$name/.webmake"
+done
+exit $failed
@@ -0,0 +1,5 @@
+import { a } from './a.js';
+import { count, inc } from './counter.js';
+inc();
+inc();
+console.log('a', a, 'count', count);
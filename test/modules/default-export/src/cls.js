@@ -0,0 +1 @@
+export default class Shape { area() { return 42; } }
@@ -0,0 +1,2 @@
+const value = { text: 'expression' };
+export default value;
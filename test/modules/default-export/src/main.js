@@ -0,0 +1,5 @@
+import fn from './fn.js';
+import named, { extra } from './named.js';
+import Shape from './cls.js';
+import expr from './expr.js';
+console.log(fn(), named(), extra, new Shape().area(), expr.text);
@@ -0,0 +1,2 @@
+export default function named() { return 'named fn'; }
+export const extra = named();
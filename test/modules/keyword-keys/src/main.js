@@ -0,0 +1,9 @@
+import { bar } from './util.js';
+
+const el = { class: 'x', function: 'f', let: 1 };
+const k = el.class + el.function + el.let;
+if (k) { console.log(bar(), k); }
+const m = { class() { return 'm'; } };
+if (m.class()) { console.log(bar(), m.class()); }
+class Real { bar() { return 'method'; } }
+console.log(new Real().bar(), bar());
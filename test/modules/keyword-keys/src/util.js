@@ -0,0 +1 @@
+export function bar() { return 'bar'; }
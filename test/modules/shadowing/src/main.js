@@ -0,0 +1,5 @@
+import { count } from './util.js';
+function show(count) {
+    return count;
+}
+console.log(show(2));
@@ -0,0 +1 @@
+export const count = 1;
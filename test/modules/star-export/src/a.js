@@ -0,0 +1,2 @@
+export function bar() { return 'a.bar'; }
+export const foo = 'a.foo';
@@ -0,0 +1,2 @@
+export * from './a.js';
+export function bar() { return 'b.bar'; }
@@ -0,0 +1,3 @@
+import { bar, foo } from './b.js';
+import * as b from './b.js';
+console.log(bar(), foo, Object.keys(b).sort().join(','));
@@ -0,0 +1,24 @@
+import { bar, flag } from './util.js';
+
+function pick(n) {
+    switch(n) {
+    case 1: {
+        return bar(1);
+    }
+    case 2: return bar(2);
+    case flag ? 3 : 4: {
+        bar(3);
+        return bar(34);
+    }
+    default: {
+        bar(0);
+        return bar('default');
+    }
+    }
+}
+outer: {
+    console.log(bar('label'));
+    break outer;
+}
+const o = flag ? { a: bar('t') } : { b: bar('f') };
+console.log(pick(1), pick(2), pick(3), pick(9), o.a, flag ?? bar(), o?.a);
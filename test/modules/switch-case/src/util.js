@@ -0,0 +1,2 @@
+export function bar(x) { return 'bar' + x; }
+export const flag = true;
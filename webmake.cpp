@@ -13,12 +13,13 @@ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLI
 
 ------------------------------------------------------------
 To compile:
-g++ -std=c++14 -Wall -fexceptions -pthread -fuse-cxa-atexit -lc4s -lsass -o webmake webmake.cpp make-html.cpp make-js.cpp make-css.cpp
+g++ -std=c++14 -Wall -fexceptions -pthread -fuse-cxa-atexit -lc4s -lsass -o webmake webmake.cpp make-html.cpp make-js.cpp make-css.cpp make-check.cpp make-module.cpp
 ? -I/usr/local/include/cpp4scripts
 */
 
 #include <sstream>
 #include <iomanip>
+#include <unistd.h>
 #include "webmake.hpp"
 
 hoedown_renderer* WebMakeApp::renderer=0;
@@ -34,6 +35,7 @@ WebMakeApp::WebMakeApp()
     // html_filter = "test";
     use_chrome_cc = false;
     run_all = true;
+    check = false;
 }
 // ------------------------------------------------------------------------------------------
 bool WebMakeApp::initializeParams()
@@ -67,6 +69,10 @@ bool WebMakeApp::initializeParams()
     }
     if(args.is_set("-css"))
         run_all=false;
+    if(args.is_set("-check")) {
+        check = true;
+        run_all=false;
+    }
     return true;
 }
 
@@ -117,6 +123,7 @@ void WebMakeApp::readVersion()
 void WebMakeApp::setTarget(const string &target, const char *ext)
 {
     dir.set_base(target);
+    targets.push_back(make_pair(dir.get_base_plain(), ext ? string(ext) : dir.get_ext()));
     if(version_str.empty()) {
         if(ext)
             dir.set_ext(ext);
@@ -130,6 +137,50 @@ void WebMakeApp::setTarget(const string &target, const char *ext)
     dir.set_base(fname.str());
 }
 // ------------------------------------------------------------------------------------------
+void WebMakeApp::beginPage(const string &name)
+{
+    current_page = name;
+    source_stack.clear();
+    page_sources[name].clear();
+}
+// ------------------------------------------------------------------------------------------
+// Adds the include chain of 'src' to the current page. Sources are stored with absolute
+// paths since html includes are processed relative to the including file's directory.
+void WebMakeApp::recordSource(const string &src)
+{
+    if(current_page.empty())
+        return;
+    string chain;
+    for(vector<string>::iterator si=source_stack.begin(); si!=source_stack.end(); si++) {
+        chain += *si;
+        chain += " > ";
+    }
+    chain += absolute_path(src);
+    page_sources[current_page].push_back(chain);
+}
+// ------------------------------------------------------------------------------------------
+void WebMakeApp::pushSource(const string &src)
+{
+    recordSource(src);
+    source_stack.push_back(absolute_path(src));
+}
+// ------------------------------------------------------------------------------------------
+// True if the name is a build target, possibly with some version postfix, that has not been
+// written in this run. These are left over from earlier builds.
+bool WebMakeApp::isStaleTarget(const string &name)
+{
+    for(vector<pair<string,string> >::iterator ti=targets.begin(); ti!=targets.end(); ti++) {
+        const string &base = ti->first, &ext = ti->second;
+        bool match = name == base+ext;
+        if(!match && name.size() > base.size()+1+ext.size())
+            match = !name.compare(0, base.size()+1, base+'_')
+                && !name.compare(name.size()-ext.size(), ext.size(), ext);
+        if(match)
+            return !artifacts.count(name);
+    }
+    return false;
+}
+// ------------------------------------------------------------------------------------------
 void WebMakeApp::parseSettingsCfg(const char *line)
 {
     if(!strncmp(line, "autoversion", 11)) {
@@ -164,6 +215,42 @@ void WebMakeApp::parseSettingsCfg(const char *line)
         dir = ptr;
     }
 }
+// ------------------------------------------------------------------------------------------
+// Removes '.', '..' and empty segments from a slash separated url path. '..' segments
+// above the root are dropped.
+string normalize_path(const string &file)
+{
+    vector<string> parts;
+    size_t start = 0;
+    while(start <= file.size()) {
+        size_t end = file.find('/', start);
+        if(end == string::npos)
+            end = file.size();
+        string seg = file.substr(start, end-start);
+        if(seg == "..") {
+            if(!parts.empty())
+                parts.pop_back();
+        }
+        else if(!seg.empty() && seg != ".")
+            parts.push_back(seg);
+        start = end+1;
+    }
+    string result;
+    for(vector<string>::iterator pi=parts.begin(); pi!=parts.end(); pi++) {
+        if(!result.empty())
+            result += '/';
+        result += *pi;
+    }
+    return result;
+}
+// ------------------------------------------------------------------------------------------
+string absolute_path(const string &file)
+{
+    char cwd[1024];
+    if(file.empty() || file[0]=='/' || !getcwd(cwd, sizeof(cwd)))
+        return file;
+    return string(cwd)+'/'+file;
+}
 // ==========================================================================================
 const int MAX_JS_BUNDLES = 10;
 int main(int argc, char **argv)
@@ -173,6 +260,7 @@ int main(int argc, char **argv)
     path_list html_files, css_files;
     path_list js_files[MAX_JS_BUNDLES];
     string js_target[MAX_JS_BUNDLES];
+    bool js_modules[MAX_JS_BUNDLES];
     int js_max = -1;
 
     WebMakeApp app;
@@ -181,6 +269,7 @@ int main(int argc, char **argv)
     app.args += argument("-html",  true,  "Builds http files with named includes.");
     app.args += argument("-js",    true,  "Builds js files with concatenate [cat] or Closure [cc].");
     app.args += argument("-css",   false, "Builds css files.");
+    app.args += argument("-check", false, "Checks href/src references of the generated html.");
     app.args += argument("-out",   true,  "Sets the output directory.");
     app.args += argument("-v",     true,  "Sets the version for css and js versioning.");
     app.args += argument("-V",     false, "Produce verbose output.");
@@ -213,15 +302,21 @@ int main(int argc, char **argv)
             state = HTML;
             continue;
         }
-        if(!strncmp("[js",line,3)) {
-            char *end = strchr(line+4, ']');
+        if(!strncmp("[js",line,3) || !strncmp("[esm",line,4)) {
+            bool esm = line[1]=='e';
+            char *end = strchr(line+(esm?5:4), ']');
             if(!end) {
                 cerr << "Incorrect JS syntax in webmake.cfg: "<<line<<'\n';
                 return 3;
             }
             *end = 0;
+            if(js_max+1 >= MAX_JS_BUNDLES) {
+                cerr << "Too many JS bundles in webmake.cfg. Maximum is "<<MAX_JS_BUNDLES<<'\n';
+                return 3;
+            }
             js_max++;
-            js_target[js_max] = line+4;
+            js_target[js_max] = line+(esm?5:4);
+            js_modules[js_max] = esm;
             state = JS;
             continue;
         }
@@ -272,12 +367,17 @@ int main(int argc, char **argv)
         if(app.isRunAll() || (app.args.is_set("-js") && js_max>=0)) {
             for(int js_ndx=0; js_ndx<=js_max; js_ndx++) {
                 app.setTarget(js_target[js_ndx]);
-                MakeJS(js_files[js_ndx], &app);
+                if(js_modules[js_ndx])
+                    MakeModules(js_files[js_ndx], &app);
+                else
+                    MakeJS(js_files[js_ndx], &app);
             }
         }
         if(app.isRunAll() || app.args.is_set("-css")) {
             MakeCSS(css_files, &app);
         }
+        if(app.isCheck() && CheckLinks(html_files, &app) > 0)
+            return 5;
     }
     catch (c4s_exception ce) {
         cerr<<"Cpp4Scripts error: "<<ce.what()<<endl;
@@ -10,6 +10,10 @@ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLI
 #include <hoedown/html.h>
 #include <iostream>
 #include <exception>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <unordered_set>
 using namespace std;
 #include <cpp4scripts/cpp4scripts.hpp>
 using namespace c4s;
@@ -31,12 +35,24 @@ public:
     bool isVerbose() { return verbose; }
     bool isChromeCC() { return use_chrome_cc; }
     bool isRunAll() { return run_all; }
+    bool isCheck() { return check; }
     bool isVersion() { return !version_str.empty(); }
     string getHtmlFilter() { return html_filter; }
+
+    // Bookkeeping for the -check stage.
+    void addArtifact(const string &name) { artifacts.insert(name); }
+    bool isStaleTarget(const string &name);
+    void beginPage(const string &name);
+    void recordSource(const string &src);
+    void pushSource(const string &src);
+    void popSource() { if(!source_stack.empty()) source_stack.pop_back(); }
+
     program_arguments args;
     path dir;
     string htmlprefix;
     string mdprefix;
+    unordered_set<string> artifacts;                      // Files written to output dir.
+    unordered_map<string, vector<string> > page_sources;  // Page -> include chains.
 
 private:
     char version_file[128];
@@ -46,15 +62,26 @@ private:
     bool verbose;
     bool use_chrome_cc;
     bool run_all;
+    bool check;
     string html_filter;
+    string current_page;
+    vector<string> source_stack;
+    vector<pair<string,string> > targets;   // Base and extension given to setTarget.
 
     static void freeMarkdown();
     static hoedown_renderer *renderer;
     static hoedown_document *document;
 };
 
+// Utilities:
+string normalize_path(const string &file);
+string absolute_path(const string &file);
+
 // Converters:
 void MakeHTML(path_list &files, WebMakeApp *app);
 void MakeCSS(path_list &files, WebMakeApp *app);
 void MakeJS(path_list &files, WebMakeApp *app);
+void MakeModules(path_list &entries, WebMakeApp *app);
+// Checker:
+int CheckLinks(path_list &html_files, WebMakeApp *app);
 